@@ -6,6 +6,7 @@
 #include "config.h"
 
 static const long defaultPollTimeMillis = 5000;
+static const long defaultConnectTimeoutMillis = 10000;
 static const char *const defaultPort = "9999";
 
 
@@ -65,6 +66,8 @@ int getEnvVars(struct config *config) {
 
     errors += getLongInRangeWithDefault("POLL_TIME_MILLIS", &config->pollTimeMillis, 0, UINT32_MAX,
                                         defaultPollTimeMillis);
+    errors += getLongInRangeWithDefault("CONNECT_TIMEOUT_MILLIS", &config->connectTimeoutMillis, 1, INT32_MAX,
+                                        defaultConnectTimeoutMillis);
     errors += getNonEmptyString("TPLINK_HOST", &config->hostname);
     errors += getStringWithDefault("TPLINK_PORT", &config->port, defaultPort);
     errors += getNonEmptyString("PUSH_GW_HOST", &config->pushGatewayHost);
@@ -74,11 +77,12 @@ int getEnvVars(struct config *config) {
     if (errors == 0) {
         printf("Polling TPLink HS110 with the following configuration: \n"
                " • Poll Frequency: %ld ms\n"
+               " • Connect Timeout: %ld ms\n"
                " • Host: %s\n"
                " • Port: %s\n"
                " • Push Gateway URI: http://%s:%s%s\n",
-               config->pollTimeMillis, config->hostname, config->port, config->pushGatewayHost,
-               config->pushGatewayPort, config->pushGatewayEndpoint);
+               config->pollTimeMillis, config->connectTimeoutMillis, config->hostname, config->port,
+               config->pushGatewayHost, config->pushGatewayPort, config->pushGatewayEndpoint);
         fflush(stdout);
         return 0;
     }
@@ -3,6 +3,7 @@
 
 struct config {
     long pollTimeMillis;
+    long connectTimeoutMillis;
     const char *hostname;
     const char *port;
     const char *pushGatewayHost;
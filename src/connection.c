@@ -2,12 +2,237 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <errno.h>
 
 #include "connection.h"
 
-int openConnection(const char *const hostname, const char *const port) {
+// Delay between starting successive connection attempts, per RFC 8305 section 5.
+static const long connectionAttemptDelayMillis = 250;
+
+#define MAX_ADDRESSES 16
+#define MAX_REMEMBERED_HOSTS 8
+#define MAX_REMEMBERED_HOSTNAME_LENGTH 256
+
+struct preferredFamily {
+    char hostname[MAX_REMEMBERED_HOSTNAME_LENGTH];
+    int family;
+};
+
+static struct preferredFamily preferredFamilies[MAX_REMEMBERED_HOSTS];
+static size_t nextPreferredFamilySlot = 0;
+
+
+int getPreferredFamily(const char *const hostname) {
+    for (size_t i = 0; i < MAX_REMEMBERED_HOSTS; i++) {
+        if (preferredFamilies[i].family != AF_UNSPEC && strcmp(preferredFamilies[i].hostname, hostname) == 0) {
+            return preferredFamilies[i].family;
+        }
+    }
+    return AF_UNSPEC;
+}
+
+static void rememberPreferredFamily(const char *const hostname, const int family) {
+    if (strlen(hostname) >= MAX_REMEMBERED_HOSTNAME_LENGTH) return;
+    for (size_t i = 0; i < MAX_REMEMBERED_HOSTS; i++) {
+        if (preferredFamilies[i].family != AF_UNSPEC && strcmp(preferredFamilies[i].hostname, hostname) == 0) {
+            preferredFamilies[i].family = family;
+            return;
+        }
+    }
+    struct preferredFamily *const slot = &preferredFamilies[nextPreferredFamilySlot];
+    nextPreferredFamilySlot = (nextPreferredFamilySlot + 1) % MAX_REMEMBERED_HOSTS;
+    strcpy(slot->hostname, hostname);
+    slot->family = family;
+}
+
+static long nowMillis(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void describeAddress(const struct addrinfo *const addrInfo, char *const out, const size_t outSize) {
+    if (getnameinfo(addrInfo->ai_addr, addrInfo->ai_addrlen, out, outSize, NULL, 0, NI_NUMERICHOST) != 0) {
+        snprintf(out, outSize, "(unknown address)");
+    }
+}
+
+// Orders the resolved addresses so that families alternate, starting with the preferred family (RFC 8305 section 4).
+static size_t interleaveAddresses(struct addrinfo *const addrInfoFirst, const int preferredFamily,
+                                  struct addrinfo **const out) {
+    struct addrinfo *preferred[MAX_ADDRESSES];
+    struct addrinfo *others[MAX_ADDRESSES];
+    size_t preferredCount = 0, otherCount = 0;
+
+    const int firstFamily = preferredFamily != AF_UNSPEC ? preferredFamily : addrInfoFirst->ai_family;
+    for (struct addrinfo *addrInfo = addrInfoFirst; addrInfo != NULL; addrInfo = addrInfo->ai_next) {
+        if (addrInfo->ai_family == firstFamily) {
+            if (preferredCount < MAX_ADDRESSES) preferred[preferredCount++] = addrInfo;
+        } else {
+            if (otherCount < MAX_ADDRESSES) others[otherCount++] = addrInfo;
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; count < MAX_ADDRESSES && (i < preferredCount || i < otherCount); i++) {
+        if (i < preferredCount) out[count++] = preferred[i];
+        if (i < otherCount && count < MAX_ADDRESSES) out[count++] = others[i];
+    }
+    return count;
+}
+
+static int startAttempt(const struct addrinfo *const addrInfo, int *const connectedImmediately) {
+    char address[NI_MAXHOST];
+    const int sck = socket(addrInfo->ai_family, SOCK_STREAM, addrInfo->ai_protocol);
+    if (sck == -1) {
+        fprintf(stderr, "Could not create socket - error %d (%s).\n", errno, strerror(errno));
+        fflush(stderr);
+        return -1;
+    }
+
+    const int flags = fcntl(sck, F_GETFL, 0);
+    if (flags == -1 || fcntl(sck, F_SETFL, flags | O_NONBLOCK) == -1) {
+        fprintf(stderr, "Could not make socket non-blocking - error %d (%s).\n", errno, strerror(errno));
+        fflush(stderr);
+        close(sck);
+        return -1;
+    }
+
+    *connectedImmediately = 0;
+    if (connect(sck, addrInfo->ai_addr, addrInfo->ai_addrlen) == 0) {
+        *connectedImmediately = 1;
+        return sck;
+    }
+    if (errno != EINPROGRESS) {
+        describeAddress(addrInfo, address, sizeof address);
+        fprintf(stderr, "Could not connect to %s - error %d (%s).\n", address, errno, strerror(errno));
+        fflush(stderr);
+        close(sck);
+        return -1;
+    }
+    return sck;
+}
+
+static int restoreBlocking(const int sck) {
+    const int flags = fcntl(sck, F_GETFL, 0);
+    if (flags == -1 || fcntl(sck, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+        fprintf(stderr, "Could not make socket blocking - error %d (%s).\n", errno, strerror(errno));
+        fflush(stderr);
+        return -1;
+    }
+    return 0;
+}
+
+int connectToAddresses(const char *const hostname, struct addrinfo *const addrInfoFirst, const long timeoutMillis) {
+    if (addrInfoFirst == NULL) return -1;
+
+    struct addrinfo *addresses[MAX_ADDRESSES];
+    const size_t addressCount = interleaveAddresses(addrInfoFirst, getPreferredFamily(hostname), addresses);
+
+    // Race the addresses against each other, starting a new attempt every connectionAttemptDelayMillis (or as soon as
+    // the previous attempt fails), and keep whichever connects first.
+    struct pollfd pending[MAX_ADDRESSES];
+    const struct addrinfo *pendingAddresses[MAX_ADDRESSES];
+    size_t pendingCount = 0;
+    size_t nextAddress = 0;
+    const long deadline = nowMillis() + timeoutMillis;
+    long nextAttemptAt = nowMillis();
+    int winner = -1;
+    const struct addrinfo *winningAddress = NULL;
+
+    while (winner == -1) {
+        long now = nowMillis();
+        if (nextAddress < addressCount && now >= nextAttemptAt) {
+            const struct addrinfo *const addrInfo = addresses[nextAddress++];
+            int connectedImmediately;
+            const int sck = startAttempt(addrInfo, &connectedImmediately);
+            if (sck == -1) {
+                nextAttemptAt = now;
+                continue;
+            }
+            if (connectedImmediately) {
+                winner = sck;
+                winningAddress = addrInfo;
+                break;
+            }
+            pending[pendingCount].fd = sck;
+            pending[pendingCount].events = POLLOUT;
+            pending[pendingCount].revents = 0;
+            pendingAddresses[pendingCount] = addrInfo;
+            pendingCount++;
+            nextAttemptAt = now + connectionAttemptDelayMillis;
+        }
+
+        if (pendingCount == 0 && nextAddress >= addressCount) break;
+        if (now >= deadline) {
+            fprintf(stderr, "Could not connect to '%s' - timed out after %ldms.\n", hostname, timeoutMillis);
+            fflush(stderr);
+            break;
+        }
+
+        long timeout = deadline - now;
+        if (nextAddress < addressCount && nextAttemptAt - now < timeout) timeout = nextAttemptAt - now;
+        if (timeout < 0) timeout = 0;
+        if (pendingCount == 0) continue;
+
+        const int ready = poll(pending, pendingCount, (int) timeout);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Could not wait for connection - error %d (%s).\n", errno, strerror(errno));
+            fflush(stderr);
+            break;
+        }
+
+        for (size_t i = 0; i < pendingCount && winner == -1;) {
+            if (pending[i].revents == 0) {
+                i++;
+                continue;
+            }
+            int socketError = 0;
+            socklen_t socketErrorLength = sizeof socketError;
+            if (getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &socketError, &socketErrorLength) == -1) {
+                socketError = errno;
+            }
+            if (socketError == 0) {
+                winner = pending[i].fd;
+                winningAddress = pendingAddresses[i];
+            } else {
+                char address[NI_MAXHOST];
+                describeAddress(pendingAddresses[i], address, sizeof address);
+                fprintf(stderr, "Could not connect to %s - error %d (%s).\n", address, socketError,
+                        strerror(socketError));
+                fflush(stderr);
+                close(pending[i].fd);
+                nextAttemptAt = nowMillis();
+            }
+            pendingCount--;
+            pending[i] = pending[pendingCount];
+            pendingAddresses[i] = pendingAddresses[pendingCount];
+        }
+    }
+
+    for (size_t i = 0; i < pendingCount; i++) {
+        close(pending[i].fd);
+    }
+
+    if (winner != -1) {
+        if (restoreBlocking(winner) == -1) {
+            close(winner);
+            winner = -1;
+        } else {
+            rememberPreferredFamily(hostname, winningAddress->ai_family);
+            // printf("Successfully connected to %s!\n", hostname);
+        }
+    }
+
+    return winner;
+}
+
+int openConnection(const char *const hostname, const char *const port, const long timeoutMillis) {
     struct addrinfo hint;
     memset(&hint, 0, sizeof hint);
     hint.ai_family = AF_UNSPEC;
@@ -20,27 +245,9 @@ int openConnection(const char *const hostname, const char *const port) {
         return -1;
     }
 
-    for (struct addrinfo *addrInfo = addrInfoFirst; addrInfo != NULL; addrInfo = addrInfo->ai_next) {
-        const int sck = socket(addrInfo->ai_family, SOCK_STREAM, addrInfo->ai_protocol);
-        if (sck == -1) {
-            fprintf(stderr, "Could not create socket - error %d (%s).\n", errno, strerror(errno));
-            fflush(stderr);
-            continue;
-        }
-
-        const int connResult = connect(sck, addrInfo->ai_addr, addrInfo->ai_addrlen);
-        if (connResult == -1) {
-            fprintf(stderr, "Could not connect - error %d (%s).\n", errno, strerror(errno));
-            fflush(stderr);
-            close(sck);
-            continue;
-        }
-
-        // printf("Successfully connected to %s!\n", hostname);
-        return sck;
-    }
+    const int sck = connectToAddresses(hostname, addrInfoFirst, timeoutMillis);
     if (addrInfoFirst != NULL) freeaddrinfo(addrInfoFirst);
-    return -1;
+    return sck;
 }
 
 void closeConnection(const int connection) {
@@ -1,7 +1,14 @@
 #ifndef TPLINK_HS110_METRICS_CLIENT_CONNECTION_H
 #define TPLINK_HS110_METRICS_CLIENT_CONNECTION_H
 
-int openConnection(const char *hostname, const char *port);
+#include <netdb.h>
+
+int openConnection(const char *hostname, const char *port, long timeoutMillis);
+
+// Races connection attempts across an already-resolved address list, remembering the winning family for hostname.
+int connectToAddresses(const char *hostname, struct addrinfo *first, long timeoutMillis);
+
+int getPreferredFamily(const char *hostname);
 
 void closeConnection(int connection);
 
@@ -108,7 +108,7 @@ void updateMetrics(const struct config *vars) {
     cJSON *sysInfoJson = NULL;
     cJSON *realTimeInfoJson = NULL;
 
-    const int connection = openConnection(vars->hostname, vars->port);
+    const int connection = openConnection(vars->hostname, vars->port, vars->connectTimeoutMillis);
     if (connection == -1) {
         fprintf(stderr, "Abandoning connection attempts to %s:%s.\n", vars->hostname, vars->port);
         fflush(stderr);
@@ -11,7 +11,7 @@ static const size_t responseBufferSize = 256;
 
 void communicateWithPushGateway(const struct config *const config, const char *const bodyBuffer,
                                 const char *const headerBuffer, const size_t bodySize, const size_t headerSize) {
-    int sck = openConnection(config->pushGatewayHost, config->pushGatewayPort);
+    int sck = openConnection(config->pushGatewayHost, config->pushGatewayPort, config->connectTimeoutMillis);
     if (sck == -1) {
         fprintf(stderr, "Couldn't open connection to push gateway\n");
         fflush(stderr);
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/connection.h"
+
+static const long testTimeoutMillis = 10000;
+static const long staggeredConnectLowerBoundMillis = 200;
+static const long staggeredConnectUpperBoundMillis = 2000;
+
+static int failures = 0;
+
+#define CHECK(condition, message) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, message); \
+            fflush(stderr); \
+            failures++; \
+        } \
+    } while (0)
+
+
+struct endpoint {
+    int fd;
+    struct sockaddr_storage address;
+    socklen_t addressLength;
+    struct addrinfo addrInfo;
+};
+
+static long nowMillis(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int countOpenFds(void) {
+    DIR *const dir = opendir("/proc/self/fd");
+    if (dir == NULL) return -1;
+    int count = 0;
+    while (readdir(dir) != NULL) count++;
+    closedir(dir);
+    return count;
+}
+
+// Binds a loopback socket on an ephemeral port; listens on it with the given backlog unless backlog is negative.
+static int bindLoopback(struct endpoint *const endpoint, const int family, const int backlog) {
+    memset(endpoint, 0, sizeof *endpoint);
+    endpoint->fd = socket(family, SOCK_STREAM, 0);
+    if (endpoint->fd == -1) return -1;
+
+    if (family == AF_INET6) {
+        struct sockaddr_in6 *const address = (struct sockaddr_in6 *) &endpoint->address;
+        address->sin6_family = AF_INET6;
+        address->sin6_addr = in6addr_loopback;
+        endpoint->addressLength = sizeof *address;
+    } else {
+        struct sockaddr_in *const address = (struct sockaddr_in *) &endpoint->address;
+        address->sin_family = AF_INET;
+        address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        endpoint->addressLength = sizeof *address;
+    }
+    if (bind(endpoint->fd, (struct sockaddr *) &endpoint->address, endpoint->addressLength) == -1) return -1;
+    if (getsockname(endpoint->fd, (struct sockaddr *) &endpoint->address, &endpoint->addressLength) == -1) return -1;
+    if (backlog >= 0 && listen(endpoint->fd, backlog) == -1) return -1;
+
+    endpoint->addrInfo.ai_family = family;
+    endpoint->addrInfo.ai_socktype = SOCK_STREAM;
+    endpoint->addrInfo.ai_addr = (struct sockaddr *) &endpoint->address;
+    endpoint->addrInfo.ai_addrlen = endpoint->addressLength;
+    return 0;
+}
+
+// Stands in for an unreachable address: once the accept queue of a zero-backlog listener is full, the kernel drops
+// further SYNs, so connecting to it hangs instead of failing.
+static int makeBlackhole(struct endpoint *const endpoint, int *const fillers, const size_t fillerCount) {
+    if (bindLoopback(endpoint, AF_INET, 0) == -1) return -1;
+    for (size_t i = 0; i < fillerCount; i++) {
+        fillers[i] = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fillers[i] == -1) return -1;
+        connect(fillers[i], (struct sockaddr *) &endpoint->address, endpoint->addressLength);
+    }
+    const struct timespec settle = {0, 100 * 1000000};
+    nanosleep(&settle, NULL);
+    return 0;
+}
+
+static int peerFamily(const int sck) {
+    struct sockaddr_storage peer;
+    socklen_t peerLength = sizeof peer;
+    if (getpeername(sck, (struct sockaddr *) &peer, &peerLength) == -1) return -1;
+    return peer.ss_family;
+}
+
+static int peerPort(const int sck) {
+    struct sockaddr_in peer;
+    socklen_t peerLength = sizeof peer;
+    if (getpeername(sck, (struct sockaddr *) &peer, &peerLength) == -1) return -1;
+    return ntohs(peer.sin_port);
+}
+
+
+static void testUnreachableFirstAddressFallsBackAfterAttemptDelay(void) {
+    struct endpoint blackhole, live;
+    int fillers[3];
+    CHECK(makeBlackhole(&blackhole, fillers, 3) == 0, "could not set up blackhole listener");
+    CHECK(bindLoopback(&live, AF_INET, 5) == 0, "could not set up live listener");
+    blackhole.addrInfo.ai_next = &live.addrInfo;
+
+    const int fdsBefore = countOpenFds();
+    const long start = nowMillis();
+    const int sck = connectToAddresses("blackhole-test", &blackhole.addrInfo, testTimeoutMillis);
+    const long elapsed = nowMillis() - start;
+
+    CHECK(sck != -1, "expected to connect to the live address");
+    CHECK(elapsed >= staggeredConnectLowerBoundMillis, "second attempt started before the attempt delay");
+    CHECK(elapsed < staggeredConnectUpperBoundMillis, "connect waited on the unreachable address");
+    CHECK(peerPort(sck) == ntohs(((struct sockaddr_in *) &live.address)->sin_port), "connected to the wrong address");
+    CHECK(countOpenFds() == fdsBefore + 1, "losing connection attempts were not closed");
+    CHECK((fcntl(sck, F_GETFL, 0) & O_NONBLOCK) == 0, "winning socket was left non-blocking");
+    printf("unreachable first address: connected in %ldms\n", elapsed);
+
+    closeConnection(sck);
+    for (size_t i = 0; i < 3; i++) close(fillers[i]);
+    close(blackhole.fd);
+    close(live.fd);
+}
+
+static void testSecondConnectTriesRememberedFamilyFirst(void) {
+    struct endpoint refusedV6, liveV4, liveV6;
+    if (bindLoopback(&refusedV6, AF_INET6, -1) == -1) {
+        printf("skipping remembered family test - IPv6 loopback unavailable\n");
+        return;
+    }
+    CHECK(bindLoopback(&liveV4, AF_INET, 5) == 0, "could not set up IPv4 listener");
+    CHECK(getPreferredFamily("family-test") == AF_UNSPEC, "expected no remembered family yet");
+
+    refusedV6.addrInfo.ai_next = &liveV4.addrInfo;
+    const int first = connectToAddresses("family-test", &refusedV6.addrInfo, testTimeoutMillis);
+    CHECK(first != -1, "expected to fall back to IPv4");
+    CHECK(peerFamily(first) == AF_INET, "expected the first connection to use IPv4");
+    CHECK(getPreferredFamily("family-test") == AF_INET, "expected IPv4 to be remembered");
+    closeConnection(first);
+
+    // IPv6 is still listed first and is now reachable, so only the remembered preference can make IPv4 win.
+    CHECK(bindLoopback(&liveV6, AF_INET6, 5) == 0, "could not set up IPv6 listener");
+    liveV6.addrInfo.ai_next = &liveV4.addrInfo;
+    const int second = connectToAddresses("family-test", &liveV6.addrInfo, testTimeoutMillis);
+    CHECK(second != -1, "expected the second connection to succeed");
+    CHECK(peerFamily(second) == AF_INET, "expected the remembered family to be tried first");
+    closeConnection(second);
+
+    close(refusedV6.fd);
+    close(liveV4.fd);
+    close(liveV6.fd);
+}
+
+int main(void) {
+    testUnreachableFirstAddressFallsBackAfterAttemptDelay();
+    testSecondConnectTriesRememberedFamilyFirst();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed.\n", failures);
+        return 1;
+    }
+    printf("All connection tests passed.\n");
+    return 0;
+}